@@ -0,0 +1,290 @@
+#include "clock_sync.h"
+#include "websocket_handler.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+// Kept well away from TradeExecution's ids so probe responses are easy to tell apart
+std::atomic<int> ClockSync::request_id{900000};
+
+ClockSync::ClockSync(WebSocketHandler& websocket, size_t window_size)
+    : websocket_(websocket),
+    window_size_(std::max<size_t>(window_size, 2)) {}
+
+int64_t ClockSync::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool ClockSync::probe(const std::string& method) {
+    int id = request_id++;
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", method},
+        {"params", json::object()}
+    };
+
+    ClockSample sample;
+    sample.t0 = nowUs();
+    websocket_.sendMessage(request);
+
+    // Frames arriving ahead of the response are queued by the handler, not dropped
+    json response = websocket_.readResponse(id);
+    if (response.is_null()) {
+        std::cerr << method << " probe response not received" << std::endl;
+        return false;
+    }
+    if (response.contains("error")) {
+        std::cerr << method << " probe failed: " << response["error"].dump() << std::endl;
+        return false;
+    }
+
+    sample.t3 = websocket_.lastReceiveUs();
+    if (response.contains("usIn") && response.contains("usOut")) {
+        sample.t1 = response["usIn"].get<int64_t>();
+        sample.t2 = response["usOut"].get<int64_t>();
+    } else if (response.contains("result") && response["result"].is_number()) {
+        // public/get_time without usIn/usOut: millisecond server time only
+        sample.t1 = sample.t2 = response["result"].get<int64_t>() * 1000;
+    } else {
+        std::cerr << method << " probe returned no server time" << std::endl;
+        return false;
+    }
+
+    sample.offset_us = ((sample.t1 - sample.t0) + (sample.t2 - sample.t3)) / 2;
+    sample.delay_us = (sample.t3 - sample.t0) - (sample.t2 - sample.t1);
+    addSample(sample);
+    return true;
+}
+
+void ClockSync::addSample(const ClockSample& sample) {
+    // A negative delay means the server timestamps are inconsistent with ours; discard it
+    if (sample.delay_us < 0) {
+        return;
+    }
+    samples_.push_back(sample);
+    if (samples_.size() > window_size_) {
+        samples_.pop_front();
+    }
+}
+
+void ClockSync::synchronize(int samples) {
+    try {
+        for (int i = 0; i < samples; ++i) {
+            probe("public/get_time");
+        }
+        updateEstimate();
+        last_sync_ = std::chrono::steady_clock::now();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in synchronize: " << e.what() << std::endl;
+    }
+}
+
+void ClockSync::updateEstimate() {
+    if (samples_.empty()) {
+        return;
+    }
+
+    // NTP clock filter: the sample with the smallest delay has the least asymmetric queuing
+    auto best = std::min_element(samples_.begin(), samples_.end(),
+        [](const ClockSample& a, const ClockSample& b) { return a.delay_us < b.delay_us; });
+    int64_t midpoint = best->t0 + (best->t3 - best->t0) / 2;
+
+    if (filtered_.empty() || filtered_.back().first != midpoint) {
+        filtered_.emplace_back(midpoint, best->offset_us);
+        if (filtered_.size() > window_size_) {
+            filtered_.pop_front();
+        }
+    }
+
+    ref_local_us_ = midpoint;
+    ref_offset_us_ = best->offset_us;
+    synchronized_ = true;
+
+    // Drift is the least squares slope of the filtered offsets against local time
+    if (filtered_.size() < 2) {
+        return;
+    }
+    double n = static_cast<double>(filtered_.size());
+    double mean_x = 0.0, mean_y = 0.0;
+    for (const auto& point : filtered_) {
+        mean_x += static_cast<double>(point.first - ref_local_us_);
+        mean_y += static_cast<double>(point.second);
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (const auto& point : filtered_) {
+        double dx = static_cast<double>(point.first - ref_local_us_) - mean_x;
+        sxx += dx * dx;
+        sxy += dx * (static_cast<double>(point.second) - mean_y);
+    }
+    drift_ = sxx > 0.0 ? sxy / sxx : 0.0;
+}
+
+void ClockSync::setResyncInterval(std::chrono::seconds interval) {
+    resync_interval_ = interval;
+}
+
+void ClockSync::resyncIfDue() {
+    checkSilentFeeds();
+    if (!synchronized_ || std::chrono::steady_clock::now() - last_sync_ >= resync_interval_) {
+        synchronize();
+    }
+}
+
+json ClockSync::enableHeartbeat(int interval_seconds) {
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", request_id++},
+            {"method", "public/set_heartbeat"},
+            {"params", {{"interval", interval_seconds}}}
+        };
+        websocket_.sendMessage(request);
+        return websocket_.readResponse(request["id"].get<int>());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in enableHeartbeat: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+json ClockSync::disableHeartbeat() {
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", request_id++},
+            {"method", "public/disable_heartbeat"},
+            {"params", json::object()}
+        };
+        websocket_.sendMessage(request);
+        return websocket_.readResponse(request["id"].get<int>());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in disableHeartbeat: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+bool ClockSync::handleHeartbeat(const json& message) {
+    if (!message.contains("method") || message["method"] != "heartbeat") {
+        return false;
+    }
+    // The exchange closes the connection unless test_requests are answered; reuse the reply as a sample
+    if (message.contains("params") && message["params"].value("type", "") == "test_request") {
+        probe("public/test");
+        updateEstimate();
+    }
+    return true;
+}
+
+int64_t ClockSync::offsetAt(int64_t local_us) const {
+    return ref_offset_us_ + static_cast<int64_t>(drift_ * static_cast<double>(local_us - ref_local_us_));
+}
+
+int64_t ClockSync::offsetUs() const {
+    return offsetAt(nowUs());
+}
+
+double ClockSync::driftPpm() const {
+    return drift_ * 1e6;
+}
+
+bool ClockSync::isSynchronized() const {
+    return synchronized_;
+}
+
+int64_t ClockSync::oneWayLatencyUs(int64_t exchange_timestamp_ms, int64_t local_receive_us) const {
+    int64_t receive_exchange_us = local_receive_us + offsetAt(local_receive_us);
+    return receive_exchange_us - exchange_timestamp_ms * 1000;
+}
+
+void ClockSync::annotate(json& notification, int64_t local_receive_us) {
+    if (!notification.contains("params")) {
+        return;
+    }
+    json& params = notification["params"];
+
+    // Silence is tracked per channel whether or not the clock is synchronized yet
+    std::string channel = params.value("channel", "");
+    if (!channel.empty()) {
+        last_seen_us_[channel] = local_receive_us;
+        silent_channels_.erase(channel);
+    }
+    if (!synchronized_ || !params.contains("data")) {
+        return;
+    }
+
+    // Trade style channels deliver an array; the newest print determines freshness
+    const json& data = params["data"];
+    int64_t timestamp_ms = 0;
+    if (data.is_array()) {
+        for (const auto& item : data) {
+            if (item.contains("timestamp")) {
+                timestamp_ms = std::max(timestamp_ms, item["timestamp"].get<int64_t>());
+            }
+        }
+    } else if (data.contains("timestamp")) {
+        timestamp_ms = data["timestamp"].get<int64_t>();
+    }
+    if (timestamp_ms == 0) {
+        return;
+    }
+
+    int64_t latency = oneWayLatencyUs(timestamp_ms, local_receive_us);
+    params["one_way_latency_us"] = latency;
+
+    ChannelLatency& stats = channel_latency_[channel];
+    if (stats.count == 0 || latency < stats.min_us) {
+        stats.min_us = latency;
+    }
+    if (stats.count == 0 || latency > stats.max_us) {
+        stats.max_us = latency;
+    }
+    stats.total_us += latency;
+    ++stats.count;
+
+    if (staleness_callback_ && staleness_threshold_.count() > 0 && latency > staleness_threshold_.count()) {
+        staleness_callback_(channel, latency);
+    }
+}
+
+void ClockSync::checkSilentFeeds() {
+    if (!staleness_callback_ || staleness_threshold_.count() <= 0) {
+        return;
+    }
+    int64_t now = nowUs();
+    for (const auto& entry : last_seen_us_) {
+        int64_t silence = now - entry.second;
+        // Alert once per silent period; the next message on the channel re-arms it
+        if (silence > staleness_threshold_.count() && silent_channels_.insert(entry.first).second) {
+            staleness_callback_(entry.first, silence);
+        }
+    }
+}
+
+void ClockSync::setStalenessAlert(std::chrono::microseconds threshold,
+                                  std::function<void(const std::string&, int64_t)> callback) {
+    staleness_threshold_ = threshold;
+    staleness_callback_ = callback;
+}
+
+void ClockSync::printStatus() const {
+    if (!synchronized_) {
+        std::cout << "Clock not synchronized with exchange" << std::endl;
+        return;
+    }
+    auto best = std::min_element(samples_.begin(), samples_.end(),
+        [](const ClockSample& a, const ClockSample& b) { return a.delay_us < b.delay_us; });
+    std::cout << "Exchange Clock Offset: " << offsetUs() << " us, Drift: " << driftPpm()
+              << " ppm, Best RTT: " << (best != samples_.end() ? best->delay_us : 0) << " us" << std::endl;
+    for (const auto& entry : channel_latency_) {
+        const ChannelLatency& stats = entry.second;
+        std::cout << entry.first << " One-Way Latency min/avg/max: " << stats.min_us << " / "
+                  << stats.averageUs() << " / " << stats.max_us << " us (" << stats.count << " messages)" << std::endl;
+    }
+}
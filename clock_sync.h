@@ -0,0 +1,115 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+using json = nlohmann::json;
+
+class WebSocketHandler;
+
+// One NTP-style exchange of public/get_time or public/test.
+// t0/t3 are local send/receive times, t1/t2 are the exchange's usIn/usOut (all epoch microseconds).
+struct ChannelLatency {
+    int64_t min_us = 0;
+    int64_t max_us = 0;
+    int64_t total_us = 0;
+    uint64_t count = 0;
+
+    int64_t averageUs() const { return count > 0 ? total_us / static_cast<int64_t>(count) : 0; }
+};
+
+struct ClockSample {
+    int64_t t0 = 0;
+    int64_t t1 = 0;
+    int64_t t2 = 0;
+    int64_t t3 = 0;
+    int64_t offset_us = 0;  // exchange clock minus local clock
+    int64_t delay_us = 0;   // round trip excluding exchange processing time
+};
+
+class ClockSync {
+public:
+    explicit ClockSync(WebSocketHandler& websocket, size_t window_size = 8);
+
+    // Send `samples` time probes back to back and refresh the offset/drift estimate
+    void synchronize(int samples = 8);
+
+    // Run synchronize() again once `interval` has elapsed since the last one
+    void setResyncInterval(std::chrono::seconds interval);
+    void resyncIfDue();
+
+    // Ask the exchange to send heartbeats (10 s is its minimum); test_requests are answered with public/test.
+    // Each heartbeat also wakes a blocked read so silent channels are noticed.
+    json enableHeartbeat(int interval_seconds = 10);
+    json disableHeartbeat();
+
+    // Returns true if `message` was a heartbeat notification and has been handled
+    bool handleHeartbeat(const json& message);
+
+    // Estimated exchange clock minus local clock at local time `local_us`
+    int64_t offsetAt(int64_t local_us) const;
+    int64_t offsetUs() const;
+    double driftPpm() const;
+    bool isSynchronized() const;
+
+    // Estimated exchange-to-us latency of a notification carrying an exchange `timestamp` (ms)
+    int64_t oneWayLatencyUs(int64_t exchange_timestamp_ms, int64_t local_receive_us) const;
+
+    // Tags a subscription notification with "one_way_latency_us", adds it to the channel's
+    // latency statistics and checks it for staleness
+    void annotate(json& notification, int64_t local_receive_us);
+
+    const std::map<std::string, ChannelLatency>& channelLatencies() const { return channel_latency_; }
+
+    // Invoked with the channel name and latency whenever a notification is older than `threshold`,
+    // or with the silence so far when a channel has sent nothing for longer than `threshold`
+    void setStalenessAlert(std::chrono::microseconds threshold,
+                           std::function<void(const std::string&, int64_t)> callback);
+
+    // Raises the staleness alert for channels that have gone quiet; also run by resyncIfDue()
+    // and after every frame pollMarketData() reads
+    void checkSilentFeeds();
+
+    // Offset, drift and the per-channel one-way latency min/avg/max
+    void printStatus() const;
+
+    static int64_t nowUs();
+
+private:
+    WebSocketHandler& websocket_;
+    size_t window_size_;
+    std::deque<ClockSample> samples_;
+
+    // Filtered (minimum delay) offsets over time, used to fit the drift
+    std::deque<std::pair<int64_t, int64_t>> filtered_;
+
+    int64_t ref_local_us_ = 0;
+    int64_t ref_offset_us_ = 0;
+    double drift_ = 0.0;  // seconds of offset change per second of local time
+    bool synchronized_ = false;
+
+    std::chrono::seconds resync_interval_{60};
+    std::chrono::steady_clock::time_point last_sync_{};
+
+    std::chrono::microseconds staleness_threshold_{0};
+    std::function<void(const std::string&, int64_t)> staleness_callback_;
+    std::map<std::string, int64_t> last_seen_us_;  // local receive time of each channel's last message
+    std::set<std::string> silent_channels_;
+    std::map<std::string, ChannelLatency> channel_latency_;
+
+    static std::atomic<int> request_id;
+
+    bool probe(const std::string& method);
+    void addSample(const ClockSample& sample);
+    void updateEstimate();
+};
+
+#endif // CLOCK_SYNC_H
@@ -2,6 +2,13 @@
 #include "websocket_handler.h"
 #include "trade_execution.h"
 #include "latency_module.h"
+#include "clock_sync.h"
+#include "trade_tape.h"
+#include "trace_recorder.h"
+#include "session_journal.h"
+#include "quote_batcher.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <exception>
@@ -13,6 +20,26 @@
 #include <chrono>
 #include <immintrin.h>
 
+// Rounds a quote price onto the instrument's tick grid (bids down, asks up, never below one tick),
+// honouring tick_size_steps where the tick widens above a price
+static double roundToTick(double price, const json& instrument, bool round_up) {
+    double tick = instrument.value("tick_size", 0.0);
+    if (instrument.contains("tick_size_steps")) {
+        for (const auto& step : instrument["tick_size_steps"]) {
+            if (price >= step.value("above_price", 0.0)) {
+                tick = std::max(tick, step.value("tick_size", tick));
+            }
+        }
+    }
+    if (tick <= 0.0) {
+        return price;
+    }
+    // The epsilon keeps prices already on the grid from moving a tick through float error
+    double ticks = price / tick;
+    double rounded = (round_up ? std::ceil(ticks - 1e-9) : std::floor(ticks + 1e-9)) * tick;
+    return std::max(rounded, tick);
+}
+
 // Dummy broadcast function (does nothing, no errors)
 void broadcastMessage(const std::string& message) {
     // Future: can be connected to real websocket clients
@@ -20,6 +47,17 @@ void broadcastMessage(const std::string& message) {
 
 void executeTrades() {
     try {
+        // Rebuild the previous session's orders, positions and market state before touching the network
+        auto recovery_start = LatencyModule::start();
+        SessionJournal journal("deribit_session.journal");
+        const JournalState& recovered = journal.recover();
+        LatencyModule::end(recovery_start, "Journal Recovery");
+        std::cout << "Recovered " << journal.recoveredRecords() << " journal records: "
+                  << recovered.open_orders.size() << " open orders, "
+                  << recovered.positions.size() << " positions, "
+                  << recovered.tickers.size() << " tickers, "
+                  << recovered.order_books.size() << " order books" << std::endl;
+
         WebSocketHandler websocket("test.deribit.com", "443", "/ws/api/v2");
         websocket.connect();
 
@@ -33,6 +71,27 @@ void executeTrades() {
             return;
         }
 
+        trade->setJournal(&journal);
+        try {
+            auto reconcile_start = LatencyModule::start();
+            int fills = trade->reconcileJournal();
+            LatencyModule::end(reconcile_start, "Journal Reconciliation");
+            std::cout << "Reconciled " << fills << " fills since last session" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error reconciling journal: " << e.what() << std::endl;
+        }
+
+        ClockSync clock_sync(websocket);
+        clock_sync.synchronize();
+        clock_sync.printStatus();
+        clock_sync.setStalenessAlert(std::chrono::milliseconds(500), [](const std::string& channel, int64_t latency_us) {
+            std::cerr << "Stale feed on " << channel << ": " << latency_us / 1000 << " ms behind exchange" << std::endl;
+        });
+        trade->setClockSync(&clock_sync);
+
+        TradeTape trade_tape;
+        QuoteBatcher quote_batcher(*trade, "default");
+        trade->setQuoteBatcher(&quote_batcher);
         std::unordered_map<std::string, json> order_cache;
 
         while (true) {
@@ -45,7 +104,10 @@ void executeTrades() {
             std::cout << "5. View Current Positions\n";
             std::cout << "6. Get Live Mark Price\n";
             std::cout << "7. View Open Orders\n";
-            std::cout << "8. Exit\n";
+            std::cout << "8. Stream Trade Tape\n";
+            std::cout << "9. Export Chrome Trace\n";
+            std::cout << "10. Requote Strikes (batched vs single-order)\n";
+            std::cout << "11. Exit\n";
             std::cout << "Enter your choice: ";
             std::cin >> choice;
 
@@ -56,9 +118,10 @@ void executeTrades() {
                 continue;
             }
 
+            clock_sync.resyncIfDue();
             auto loop_start = LatencyModule::start();
 
-            if (choice == 8) {
+            if (choice == 11) {
                 std::cout << "Exiting trading application.\n";
                 break;
             }
@@ -266,6 +329,105 @@ void executeTrades() {
                     break;
                 }
 
+                case 8: { // Stream Trade Tape
+                    std::string instrument;
+                    int messages;
+                    std::cout << "Enter instrument name: ";
+                    std::cin >> instrument;
+                    std::cout << "Enter number of messages to read: ";
+                    std::cin >> messages;
+
+                    try {
+                        trade->subscribeTrades(instrument, [&trade_tape](const json& trades) {
+                            trade_tape.onTrades(trades);
+                        });
+                        auto stream_start = LatencyModule::start();
+                        trade->pollMarketData(messages);
+                        LatencyModule::end(stream_start, "Trade Tape Streaming");
+
+                        // Stop the stream so later request/response calls are not interleaved with prints
+                        trade->unsubscribeTrades(instrument);
+                        trade->dispatchPending();
+                        // Rolling figures are evaluated at the exchange's current time
+                        trade_tape.printSummary(instrument, (ClockSync::nowUs() + clock_sync.offsetUs()) / 1000);
+                        clock_sync.printStatus();
+                    } catch (const std::exception& e) {
+                        std::cerr << "Error streaming trades: " << e.what() << std::endl;
+                    }
+                    break;
+                }
+
+                case 9: { // Export Chrome Trace
+                    std::string path;
+                    std::cout << "Enter output file (e.g. trace.json): ";
+                    std::cin >> path;
+                    TraceRecorder::exportChromeTrace(path);
+                    break;
+                }
+
+                case 10: { // Requote Strikes (batched vs single-order)
+                    std::string currency;
+                    int strikes, rounds;
+                    double amount, spread;
+                    std::cout << "Enter currency (e.g. BTC): ";
+                    std::cin >> currency;
+                    std::cout << "Enter number of option strikes: ";
+                    std::cin >> strikes;
+                    std::cout << "Enter number of requote rounds: ";
+                    std::cin >> rounds;
+                    std::cout << "Enter quote amount: ";
+                    std::cin >> amount;
+                    std::cout << "Enter spread around mark price: ";
+                    std::cin >> spread;
+
+                    try {
+                        json instruments = trade->getInstruments(currency, "option", false);
+                        std::vector<std::pair<json, double>> marks;  // instrument metadata, mark price
+                        if (instruments.contains("result")) {
+                            for (const auto& item : instruments["result"]) {
+                                if (static_cast<int>(marks.size()) >= strikes) {
+                                    break;
+                                }
+                                std::string name = item["instrument_name"];
+                                json ticker = trade->getTicker(name);
+                                if (ticker.contains("result")) {
+                                    marks.emplace_back(item, ticker["result"].value("mark_price", 0.0));
+                                }
+                            }
+                        }
+
+                        for (bool batching : {false, true}) {
+                            quote_batcher.setBatching(batching);
+                            quote_batcher.resetStats();
+                            for (int round = 0; round < rounds; ++round) {
+                                // Alternate the quote width so every round changes every strike
+                                double width = spread * (1.0 + (round % 2));
+                                for (const auto& mark : marks) {
+                                    const json& instrument = mark.first;
+                                    double bid = roundToTick(std::max(mark.second - width, spread), instrument, false);
+                                    double ask = roundToTick(mark.second + width, instrument, true);
+                                    quote_batcher.updateQuote(instrument["instrument_name"].get<std::string>(),
+                                                              Quote{bid, amount, ask, amount});
+                                }
+                                std::this_thread::sleep_until(quote_batcher.deadline());
+                                quote_batcher.flushIfDue();
+                            }
+                            RequoteStats measured = quote_batcher.stats();
+
+                            for (const auto& mark : marks) {
+                                quote_batcher.pullQuote(mark.first["instrument_name"].get<std::string>());
+                            }
+                            quote_batcher.flush();
+                            std::cout << (batching ? "Batched" : "Single-Order") << " Requotes: " << measured.requotes
+                                      << ", Messages/Requote: " << measured.messagesPerRequote()
+                                      << ", Avg Requote Latency: " << measured.averageLatencyUs() << " us" << std::endl;
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Error requoting strikes: " << e.what() << std::endl;
+                    }
+                    break;
+                }
+
                 default:
                     std::cout << "Invalid choice. Please try again.\n";
                     break;
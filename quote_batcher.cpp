@@ -0,0 +1,326 @@
+#include "quote_batcher.h"
+#include "trade_execution.h"
+#include "latency_module.h"
+#include <iostream>
+#include <set>
+
+static bool isPull(const Quote& quote) {
+    return quote.bid_amount <= 0.0 && quote.ask_amount <= 0.0;
+}
+
+QuoteBatcher::QuoteBatcher(TradeExecution& trade, const std::string& mmp_group, std::chrono::microseconds window)
+    : trade_(trade),
+    mmp_group_(mmp_group),
+    window_(window) {}
+
+void QuoteBatcher::setWindow(std::chrono::microseconds window) {
+    window_ = window;
+}
+
+void QuoteBatcher::setBatching(bool enabled) {
+    batching_ = enabled;
+}
+
+void QuoteBatcher::openWindow() {
+    if (!window_open_) {
+        window_open_ = true;
+        window_start_ = std::chrono::steady_clock::now();
+        deadline_ = window_start_ + window_;
+    }
+}
+
+void QuoteBatcher::stage(const std::string& instrument_name, const Quote& quote) {
+    openWindow();
+    // Later updates within the window replace earlier ones, only the last one is sent
+    pending_[instrument_name] = quote;
+    retries_.erase(instrument_name);
+    flushIfDue();
+}
+
+void QuoteBatcher::retry(const std::string& instrument_name, const Quote& quote) {
+    if (++retries_[instrument_name] > MAX_RETRIES) {
+        std::cerr << "Giving up on quote for " << instrument_name << " after " << MAX_RETRIES << " retries" << std::endl;
+        retries_.erase(instrument_name);
+        return;
+    }
+    // A newer update staged in the meantime wins over the rejected one
+    pending_.insert({instrument_name, quote});
+    openWindow();
+}
+
+void QuoteBatcher::updateQuote(const std::string& instrument_name, const Quote& quote) {
+    stage(instrument_name, quote);
+}
+
+void QuoteBatcher::pullQuote(const std::string& instrument_name) {
+    stage(instrument_name, Quote{});
+}
+
+void QuoteBatcher::flushIfDue() {
+    if (window_open_ && std::chrono::steady_clock::now() >= deadline_) {
+        flush();
+    }
+}
+
+void QuoteBatcher::flush() {
+    window_open_ = false;
+    auto window_start = window_start_;
+    if (pending_.empty()) {
+        return;
+    }
+
+    // Diff against what is live so unchanged quotes cost nothing
+    std::map<std::string, Quote> changed;
+    for (const auto& entry : pending_) {
+        auto live = live_.find(entry.first);
+        if (isPull(entry.second) ? live != live_.end() : (live == live_.end() || live->second != entry.second)) {
+            changed.insert(entry);
+        }
+    }
+    pending_.clear();
+    if (changed.empty()) {
+        return;
+    }
+
+    // Latency includes the time the first update waited in the window, not just the send
+    RequoteStats& stats = batching_ ? batched_stats_ : single_stats_;
+    uint64_t messages = batching_ ? sendBatched(changed) : sendSingle(changed);
+    auto elapsed = std::chrono::steady_clock::now() - window_start;
+
+    if (messages > 0) {
+        ++stats.requotes;
+        stats.messages += messages;
+        stats.quotes_sent += changed.size();
+        stats.total_latency_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+}
+
+static bool isRejected(const json& response, const char* action) {
+    if (response.is_null() || response.contains("error")) {
+        std::cerr << action << " rejected: " << (response.is_null() ? "no response" : response["error"].dump()) << std::endl;
+        return true;
+    }
+    return false;
+}
+
+uint64_t QuoteBatcher::sendBatched(const std::map<std::string, Quote>& changed) {
+    uint64_t messages = 0;
+    json quotes = json::array();
+    for (const auto& entry : changed) {
+        const Quote& quote = entry.second;
+        if (isPull(quote)) {
+            continue;
+        }
+        auto live = live_.find(entry.first);
+        bool had_bid = live != live_.end() && live->second.bid_amount > 0.0;
+        bool had_ask = live != live_.end() && live->second.ask_amount > 0.0;
+
+        // A side that drops out is sent with amount 0 so the resting order is cancelled explicitly
+        json item = {{"instrument_name", entry.first}};
+        if (quote.bid_amount > 0.0 || had_bid) {
+            item["bid"] = {{"price", quote.bid_amount > 0.0 ? quote.bid_price : live->second.bid_price},
+                           {"amount", quote.bid_amount}};
+        }
+        if (quote.ask_amount > 0.0 || had_ask) {
+            item["ask"] = {{"price", quote.ask_amount > 0.0 ? quote.ask_price : live->second.ask_price},
+                           {"amount", quote.ask_amount}};
+        }
+        quotes.push_back(item);
+    }
+
+    if (!quotes.empty()) {
+        json response;
+        try {
+            response = trade_.massQuote(std::to_string(next_quote_id_++), mmp_group_, quotes);
+            ++messages;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error sending batched quotes: " << e.what() << std::endl;
+        }
+
+        // Sides listed in the errors array were rejected individually; the rest of the batch stands
+        std::map<std::string, std::set<std::string>> failed_sides;
+        bool rejected = isRejected(response, "Mass quote");
+        if (!rejected && response["result"].contains("errors")) {
+            for (const auto& error : response["result"]["errors"]) {
+                std::string instrument = error.value("instrument_name", "");
+                std::string side = error.value("side", "");
+                std::cerr << "Quote rejected for " << instrument << " " << side << ": " << error.dump() << std::endl;
+                if (side.empty()) {
+                    failed_sides[instrument] = {"bid", "ask"};
+                } else {
+                    failed_sides[instrument].insert(side);
+                }
+            }
+        }
+
+        for (const auto& entry : changed) {
+            if (isPull(entry.second)) {
+                continue;
+            }
+            // Mass quotes replace whatever single orders were resting under their own ids
+            resting_.erase(entry.first);
+            auto failed = failed_sides.find(entry.first);
+            if (!rejected && failed == failed_sides.end()) {
+                live_[entry.first] = entry.second;
+                retries_.erase(entry.first);
+                continue;
+            }
+
+            // Rejected sides keep what was resting before, and the quote is staged again
+            auto live = live_.find(entry.first);
+            Quote accepted = entry.second;
+            Quote previous = live != live_.end() ? live->second : Quote{};
+            if (rejected || failed->second.count("bid")) {
+                accepted.bid_price = previous.bid_price;
+                accepted.bid_amount = previous.bid_amount;
+            }
+            if (rejected || failed->second.count("ask")) {
+                accepted.ask_price = previous.ask_price;
+                accepted.ask_amount = previous.ask_amount;
+            }
+            if (isPull(accepted)) {
+                live_.erase(entry.first);
+            } else {
+                live_[entry.first] = accepted;
+            }
+            retry(entry.first, entry.second);
+        }
+    }
+
+    // Pulls go out whatever happened to the mass quote
+    for (const auto& entry : changed) {
+        if (!isPull(entry.second)) {
+            continue;
+        }
+        try {
+            json response = trade_.cancelAllByInstrument(entry.first);
+            ++messages;
+            if (isRejected(response, "Cancel all by instrument")) {
+                retry(entry.first, entry.second);
+                continue;
+            }
+            live_.erase(entry.first);
+            resting_.erase(entry.first);
+            retries_.erase(entry.first);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error pulling quote for " << entry.first << ": " << e.what() << std::endl;
+            retry(entry.first, entry.second);
+        }
+    }
+    return messages;
+}
+
+bool QuoteBatcher::sendSide(const std::string& instrument_name, bool bid, double price, double amount,
+                            std::string& order_id, uint64_t& messages) {
+    // One message per side: edit the resting order, place a new one, or cancel it
+    json response;
+    if (amount > 0.0 && !order_id.empty()) {
+        response = trade_.modifyOrder(order_id, price, amount);
+    } else if (amount > 0.0) {
+        response = bid ? trade_.placeBuyOrder(instrument_name, amount, price)
+                       : trade_.placeSellOrder(instrument_name, amount, price);
+    } else if (!order_id.empty()) {
+        response = trade_.cancelOrder(order_id);
+    } else {
+        return true;
+    }
+    ++messages;
+    if (isRejected(response, bid ? "Bid quote" : "Ask quote")) {
+        return false;
+    }
+
+    // A new or edited order that filled straight away is no longer resting
+    const json& result = response["result"];
+    std::string order_state = result.contains("order") ? result["order"].value("order_state", "") : "";
+    if (amount > 0.0 && order_state == "open") {
+        order_id = result["order"].value("order_id", order_id);
+    } else {
+        order_id.clear();
+    }
+    return true;
+}
+
+uint64_t QuoteBatcher::sendSingle(const std::map<std::string, Quote>& changed) {
+    uint64_t messages = 0;
+    for (const auto& entry : changed) {
+        const std::string& instrument = entry.first;
+        const Quote& quote = entry.second;
+        auto live = live_.find(instrument);
+        Quote accepted = live != live_.end() ? live->second : Quote{};
+        RestingOrders& orders = resting_[instrument];
+        bool ok = true;
+
+        try {
+            // Quotes left by mass_quote have no order ids here; clear them once, then use ids from now on
+            if ((accepted.bid_amount > 0.0 && orders.bid_order_id.empty()) ||
+                (accepted.ask_amount > 0.0 && orders.ask_order_id.empty())) {
+                json response = trade_.cancelAllByInstrument(instrument);
+                ++messages;
+                if (isRejected(response, "Cancel all by instrument")) {
+                    retry(instrument, quote);
+                    continue;
+                }
+                accepted = Quote{};
+                orders = RestingOrders{};
+            }
+
+            // Only the sides the exchange accepted and that are still resting are recorded as live
+            if (sendSide(instrument, true, quote.bid_price, quote.bid_amount, orders.bid_order_id, messages)) {
+                accepted.bid_price = quote.bid_price;
+                accepted.bid_amount = orders.bid_order_id.empty() ? 0.0 : quote.bid_amount;
+            } else {
+                ok = false;
+            }
+            if (sendSide(instrument, false, quote.ask_price, quote.ask_amount, orders.ask_order_id, messages)) {
+                accepted.ask_price = quote.ask_price;
+                accepted.ask_amount = orders.ask_order_id.empty() ? 0.0 : quote.ask_amount;
+            } else {
+                ok = false;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error sending single quotes for " << instrument << ": " << e.what() << std::endl;
+            ok = false;
+        }
+
+        if (isPull(accepted)) {
+            live_.erase(instrument);
+        } else {
+            live_[instrument] = accepted;
+        }
+        if (orders.bid_order_id.empty() && orders.ask_order_id.empty()) {
+            resting_.erase(instrument);
+        }
+        if (ok) {
+            retries_.erase(instrument);
+        } else {
+            retry(instrument, quote);
+        }
+    }
+    return messages;
+}
+
+json QuoteBatcher::cancelByLabel(const std::string& label) {
+    auto start = LatencyModule::start();
+    json response = trade_.cancelByLabel(label);
+    LatencyModule::end(start, "Cancel By Label");
+    return response;
+}
+
+void QuoteBatcher::printStats() const {
+    auto print = [](const char* name, const RequoteStats& stats) {
+        std::cout << name << " Requotes: " << stats.requotes
+                  << ", Quotes: " << stats.quotes_sent
+                  << ", Messages/Requote: " << stats.messagesPerRequote()
+                  << ", Avg Requote Latency: " << stats.averageLatencyUs() << " us" << std::endl;
+    };
+    print("Batched", batched_stats_);
+    print("Single-Order", single_stats_);
+}
+
+void QuoteBatcher::resetStats() {
+    batched_stats_ = RequoteStats();
+    single_stats_ = RequoteStats();
+}
@@ -0,0 +1,108 @@
+#ifndef QUOTE_BATCHER_H
+#define QUOTE_BATCHER_H
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+using json = nlohmann::json;
+
+class TradeExecution;
+
+// Two-sided quote for one instrument; a side with zero amount is not quoted
+struct Quote {
+    double bid_price = 0.0;
+    double bid_amount = 0.0;
+    double ask_price = 0.0;
+    double ask_amount = 0.0;
+
+    bool operator==(const Quote& other) const {
+        return bid_price == other.bid_price && bid_amount == other.bid_amount &&
+               ask_price == other.ask_price && ask_amount == other.ask_amount;
+    }
+    bool operator!=(const Quote& other) const { return !(*this == other); }
+};
+
+struct RequoteStats {
+    uint64_t requotes = 0;        // flushes that sent at least one message
+    uint64_t messages = 0;
+    uint64_t quotes_sent = 0;     // instruments whose quote changed
+    int64_t total_latency_ns = 0; // first staged update of the window to the last acknowledgement
+
+    double messagesPerRequote() const { return requotes ? static_cast<double>(messages) / requotes : 0.0; }
+    double averageLatencyUs() const { return requotes ? total_latency_ns / 1000.0 / requotes : 0.0; }
+};
+
+// Collects quote updates for a short window and sends only what changed,
+// as one private/mass_quote plus one cancel_all_by_instrument per pulled instrument
+class QuoteBatcher {
+public:
+    QuoteBatcher(TradeExecution& trade, const std::string& mmp_group,
+                 std::chrono::microseconds window = std::chrono::microseconds(500));
+
+    void setWindow(std::chrono::microseconds window);
+
+    // With batching off every changed quote goes through the regular order API, one message per side
+    // (edit the resting order, or place/cancel it), for comparison; stats for the two modes are kept separately
+    void setBatching(bool enabled);
+
+    // Stage a new quote or pull one; the first staged change opens the window and sets the deadline.
+    // Quotes the exchange rejects are staged again, up to MAX_RETRIES times.
+    void updateQuote(const std::string& instrument_name, const Quote& quote);
+    void pullQuote(const std::string& instrument_name);
+
+    // Flushes once the deadline has passed; call from the poll loop so the tail of a burst goes out
+    // even if no further update arrives
+    void flushIfDue();
+    void flush();
+
+    bool hasPending() const { return window_open_; }
+    std::chrono::steady_clock::time_point deadline() const { return deadline_; }
+
+    // Cancels every order tagged with `label` in one message
+    json cancelByLabel(const std::string& label);
+
+    const std::map<std::string, Quote>& liveQuotes() const { return live_; }
+    const RequoteStats& stats() const { return batching_ ? batched_stats_ : single_stats_; }
+    void printStats() const;
+    void resetStats();
+
+    static constexpr int MAX_RETRIES = 3;
+
+private:
+    // Order ids of the single-order path's resting orders; mass quotes are tracked by instrument only
+    struct RestingOrders {
+        std::string bid_order_id;
+        std::string ask_order_id;
+    };
+
+    TradeExecution& trade_;
+    std::string mmp_group_;
+    std::chrono::microseconds window_;
+    bool batching_ = true;
+
+    std::map<std::string, Quote> live_;
+    std::map<std::string, Quote> pending_;  // zero amounts on both sides means pull
+    std::map<std::string, RestingOrders> resting_;
+    std::map<std::string, int> retries_;
+    bool window_open_ = false;
+    std::chrono::steady_clock::time_point window_start_;
+    std::chrono::steady_clock::time_point deadline_;
+
+    uint64_t next_quote_id_ = 1;
+    RequoteStats batched_stats_;
+    RequoteStats single_stats_;
+
+    void openWindow();
+    void stage(const std::string& instrument_name, const Quote& quote);
+    void retry(const std::string& instrument_name, const Quote& quote);
+    // Both return the number of messages sent and only mark quotes live once the exchange accepted them
+    uint64_t sendBatched(const std::map<std::string, Quote>& changed);
+    uint64_t sendSingle(const std::map<std::string, Quote>& changed);
+    bool sendSide(const std::string& instrument_name, bool bid, double price, double amount,
+                  std::string& order_id, uint64_t& messages);
+};
+
+#endif // QUOTE_BATCHER_H
@@ -0,0 +1,166 @@
+// Requote benchmark: drives QuoteBatcher against a loopback TLS WebSocket server that answers
+// every JSON-RPC request immediately, and reports messages per requote and requote latency
+// (first staged update to last acknowledgement) for the single-order path (buy/sell, then
+// edit per side) and the batched mass_quote path.
+//
+// Usage: requote_bench [strikes] [rounds] [server_delay_us]
+
+#include "websocket_handler.h"
+#include "trade_execution.h"
+#include "quote_batcher.h"
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Self-signed certificate for the loopback server; the client does not verify peers
+static void useSelfSignedCertificate(ssl::context& ctx) {
+    EVP_PKEY* pkey = nullptr;
+    EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    EVP_PKEY_keygen_init(kctx);
+    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1);
+    EVP_PKEY_keygen(kctx, &pkey);
+    EVP_PKEY_CTX_free(kctx);
+
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, pkey);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, pkey, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), pkey);
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+}
+
+static json mockResult(const json& request, int& next_order_id) {
+    std::string method = request.value("method", "");
+    const json& params = request.contains("params") ? request["params"] : json::object();
+    if (method == "public/auth") {
+        return {{"access_token", "bench"}, {"expires_in", 900}};
+    }
+    if (method == "private/buy" || method == "private/sell") {
+        return {{"order", {
+            {"order_id", std::to_string(next_order_id++)},
+            {"order_state", "open"},
+            {"instrument_name", params.value("instrument_name", "")},
+            {"price", params.value("price", 0.0)},
+            {"amount", params.value("amount", 0.0)}
+        }}, {"trades", json::array()}};
+    }
+    if (method == "private/edit") {
+        return {{"order", {
+            {"order_id", params.value("order_id", "")},
+            {"order_state", "open"},
+            {"price", params.value("new_price", 0.0)},
+            {"amount", params.value("new_amount", 0.0)}
+        }}, {"trades", json::array()}};
+    }
+    if (method == "private/cancel") {
+        return {{"order_id", params.value("order_id", "")}, {"order_state", "cancelled"}};
+    }
+    if (method == "private/mass_quote") {
+        return {{"pending_requests", json::array()}, {"errors", json::array()}};
+    }
+    if (method == "private/cancel_all_by_instrument") {
+        return 2;
+    }
+    return json::object();
+}
+
+static void runServer(tcp::acceptor& acceptor, ssl::context& ctx, std::chrono::microseconds delay) {
+    try {
+        tcp::socket socket(acceptor.get_executor());
+        acceptor.accept(socket);
+        socket.set_option(tcp::no_delay(true));
+        beast::websocket::stream<ssl::stream<tcp::socket>> ws(std::move(socket), ctx);
+        ws.next_layer().handshake(ssl::stream_base::server);
+        ws.accept();
+
+        int next_order_id = 1;
+        while (true) {
+            beast::flat_buffer buffer;
+            ws.read(buffer);
+            json request = json::parse(beast::buffers_to_string(buffer.data()));
+            if (delay.count() > 0) {
+                std::this_thread::sleep_for(delay);
+            }
+            json response = {
+                {"jsonrpc", "2.0"},
+                {"id", request["id"]},
+                {"result", mockResult(request, next_order_id)}
+            };
+            std::string response_str = response.dump();
+            ws.write(asio::buffer(response_str));
+        }
+    }
+    catch (const std::exception&) {
+        // Client closed the connection
+    }
+}
+
+int main(int argc, char** argv) {
+    int strikes = argc > 1 ? std::atoi(argv[1]) : 50;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+    std::chrono::microseconds delay(argc > 3 ? std::atoi(argv[3]) : 0);
+
+    asio::io_context server_ioc;
+    ssl::context server_ctx(ssl::context::tlsv12_server);
+    useSelfSignedCertificate(server_ctx);
+    tcp::acceptor acceptor(server_ioc, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    std::thread server([&] { runServer(acceptor, server_ctx, delay); });
+
+    // Per-message logging goes to std::cout; silence it so the numbers measure the send path
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+
+    WebSocketHandler websocket("127.0.0.1", std::to_string(acceptor.local_endpoint().port()), "/");
+    websocket.connect();
+    TradeExecution trade(websocket);
+    trade.authenticate("bench", "bench");
+    QuoteBatcher batcher(trade, "bench");
+
+    RequoteStats results[2];
+    for (bool batching : {false, true}) {
+        batcher.setBatching(batching);
+        batcher.resetStats();
+        for (int round = 0; round < rounds; ++round) {
+            double width = 5.0 * (1 + round % 2);
+            for (int strike = 0; strike < strikes; ++strike) {
+                double mark = 100.0 + strike;
+                batcher.updateQuote("BTC-27DEC24-" + std::to_string(50000 + strike * 1000) + "-C",
+                                    Quote{mark - width, 1.0, mark + width, 1.0});
+            }
+            std::this_thread::sleep_until(batcher.deadline());
+            batcher.flushIfDue();
+        }
+        results[batching ? 1 : 0] = batcher.stats();
+
+        for (int strike = 0; strike < strikes; ++strike) {
+            batcher.pullQuote("BTC-27DEC24-" + std::to_string(50000 + strike * 1000) + "-C");
+        }
+        batcher.flush();
+    }
+
+    websocket.close();
+    std::cout.rdbuf(console);
+    server.join();
+
+    std::cout << strikes << " strikes, " << rounds << " rounds, server delay " << delay.count() << " us" << std::endl;
+    const char* names[2] = {"Single-Order", "Batched"};
+    for (int i = 0; i < 2; ++i) {
+        std::cout << names[i] << ": requotes " << results[i].requotes
+                  << ", messages/requote " << results[i].messagesPerRequote()
+                  << ", avg requote latency " << results[i].averageLatencyUs() << " us" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "session_journal.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace bip = boost::interprocess;
+
+static const uint64_t JOURNAL_MAGIC = 0x4C4E524A54425244ull;  // "DRBTJRNL"
+static const uint32_t JOURNAL_VERSION = 2;
+
+struct SessionJournal::FileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t write_offset;  // end of the last published record; also selects the active half
+};
+
+struct SessionJournal::RecordHeader {
+    uint32_t length;        // payload bytes
+    uint16_t type;
+    uint16_t reserved;
+    int64_t timestamp_us;
+};
+
+// Records start on 8 byte boundaries so headers can be read in place
+static uint64_t alignUp(uint64_t value) {
+    return (value + 7) & ~uint64_t{7};
+}
+
+static uint64_t alignDown(uint64_t value) {
+    return value & ~uint64_t{7};
+}
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool isValidType(uint16_t type) {
+    return type >= static_cast<uint16_t>(JournalRecordType::Order) &&
+           type <= static_cast<uint16_t>(JournalRecordType::OrderBook);
+}
+
+void JournalState::apply(JournalRecordType type, const json& payload) {
+    switch (type) {
+        case JournalRecordType::Order: {
+            std::string order_id = payload.value("order_id", "");
+            if (order_id.empty()) {
+                break;
+            }
+            std::string order_state = payload.value("order_state", "open");
+            if (order_state == "open" || order_state == "untriggered") {
+                open_orders[order_id] = payload;
+            } else {
+                open_orders.erase(order_id);
+            }
+            break;
+        }
+        case JournalRecordType::Position: {
+            std::string instrument = payload.value("instrument_name", "");
+            if (instrument.empty()) {
+                break;
+            }
+            if (payload.value("size", 0.0) == 0.0) {
+                positions.erase(instrument);
+            } else {
+                positions[instrument] = payload;
+            }
+            break;
+        }
+        case JournalRecordType::Ticker:
+            if (payload.contains("instrument_name")) {
+                tickers[payload["instrument_name"].get<std::string>()] = payload;
+            }
+            break;
+        case JournalRecordType::OrderBook:
+            if (payload.contains("instrument_name")) {
+                order_books[payload["instrument_name"].get<std::string>()] = payload;
+            }
+            break;
+    }
+}
+
+SessionJournal::SessionJournal(const std::string& path, uint64_t capacity)
+    : path_(path),
+    capacity_(capacity) {
+    // Create the file if missing; an existing journal keeps its size so both halves stay where
+    // the previous session put them
+    { std::ofstream create(path_, std::ios::binary | std::ios::app); }
+    uint64_t size = std::filesystem::file_size(path_);
+    if (size < sizeof(FileHeader)) {
+        std::filesystem::resize_file(path_, capacity_);
+    } else {
+        capacity_ = size;
+    }
+    split_ = alignUp(capacity_ / 2);
+    if (split_ < alignUp(sizeof(FileHeader)) + sizeof(RecordHeader) + 8 ||
+        alignDown(capacity_) < split_ + sizeof(RecordHeader)) {
+        throw std::runtime_error("Journal capacity too small: " + path_);
+    }
+
+    file_ = bip::file_mapping(path_.c_str(), bip::read_write);
+    region_ = bip::mapped_region(file_, bip::read_write, 0, capacity_);
+    base_ = static_cast<char*>(region_.get_address());
+    header_ = reinterpret_cast<FileHeader*>(base_);
+
+    uint64_t offset = header_->write_offset;
+    bool in_low = offset >= alignUp(sizeof(FileHeader)) && offset <= split_ - 8;
+    bool in_high = offset >= split_ && offset <= alignDown(capacity_);
+    if (header_->magic != JOURNAL_MAGIC || header_->version != JOURNAL_VERSION || !(in_low || in_high)) {
+        reset();
+    }
+}
+
+SessionJournal::~SessionJournal() {
+    try {
+        flush();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error flushing journal: " << e.what() << std::endl;
+    }
+}
+
+void SessionJournal::reset() {
+    header_->magic = JOURNAL_MAGIC;
+    header_->version = JOURNAL_VERSION;
+    header_->reserved = 0;
+    header_->write_offset = alignUp(sizeof(FileHeader));
+}
+
+// The data area is split in two halves: [header, split - 8] and [split, capacity]. Appends go
+// to the half write_offset points into; compaction rebuilds into the other one.
+uint64_t SessionJournal::activeBegin() const {
+    return header_->write_offset >= split_ ? split_ : alignUp(sizeof(FileHeader));
+}
+
+uint64_t SessionJournal::activeLimit() const {
+    return header_->write_offset >= split_ ? alignDown(capacity_) : split_ - 8;
+}
+
+uint64_t SessionJournal::bytesUsed() const {
+    return header_->write_offset - activeBegin();
+}
+
+const JournalState& SessionJournal::recover() {
+    state_ = JournalState();
+    recovered_records_ = 0;
+
+    uint64_t offset = activeBegin();
+    uint64_t end = header_->write_offset;
+    while (offset + sizeof(RecordHeader) <= end) {
+        const RecordHeader* record = reinterpret_cast<const RecordHeader*>(base_ + offset);
+        uint64_t payload_offset = offset + sizeof(RecordHeader);
+        if (!isValidType(record->type) || payload_offset + record->length > end) {
+            break;
+        }
+
+        try {
+            const uint8_t* payload = reinterpret_cast<const uint8_t*>(base_ + payload_offset);
+            json data = json::from_msgpack(payload, payload + record->length);
+            state_.apply(static_cast<JournalRecordType>(record->type), data);
+            state_.last_event_us = record->timestamp_us;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Corrupt journal record at offset " << offset << ": " << e.what() << std::endl;
+            break;
+        }
+
+        ++recovered_records_;
+        offset = alignUp(payload_offset + record->length);
+    }
+
+    // Anything past the last good record is discarded so new appends follow it
+    if (offset < end) {
+        std::cerr << "Journal truncated at offset " << offset << std::endl;
+        header_->write_offset = offset;
+    }
+    return state_;
+}
+
+bool SessionJournal::write(uint64_t& offset, uint64_t limit, JournalRecordType type, int64_t timestamp_us,
+                           const std::vector<uint8_t>& bytes) {
+    uint64_t next = alignUp(offset + sizeof(RecordHeader) + bytes.size());
+    if (next > limit) {
+        return false;
+    }
+
+    RecordHeader record{static_cast<uint32_t>(bytes.size()), static_cast<uint16_t>(type), 0, timestamp_us};
+    std::memcpy(base_ + offset, &record, sizeof(record));
+    std::memcpy(base_ + offset + sizeof(record), bytes.data(), bytes.size());
+    offset = next;
+    return true;
+}
+
+void SessionJournal::publish(uint64_t offset) {
+    // Records must be complete in the mapping before replay can see them
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->write_offset = offset;
+}
+
+void SessionJournal::append(JournalRecordType type, const json& payload) {
+    int64_t timestamp = nowUs();
+    state_.apply(type, payload);
+    state_.last_event_us = timestamp;
+
+    uint64_t offset = header_->write_offset;
+    if (write(offset, activeLimit(), type, timestamp, json::to_msgpack(payload))) {
+        publish(offset);
+    } else {
+        // The snapshot already includes this record through state_
+        compact();
+    }
+}
+
+void SessionJournal::compact() {
+    // Build the snapshot in the idle half; the active half stays replayable until the single
+    // store in publish() switches over, so a crash part way through loses nothing
+    bool active_high = header_->write_offset >= split_;
+    uint64_t offset = active_high ? alignUp(sizeof(FileHeader)) : split_;
+    uint64_t limit = active_high ? split_ - 8 : alignDown(capacity_);
+
+    int64_t timestamp = state_.last_event_us;
+    auto snapshot = [&](JournalRecordType type, const std::map<std::string, json>& entries) {
+        for (const auto& entry : entries) {
+            if (!write(offset, limit, type, timestamp, json::to_msgpack(entry.second))) {
+                throw std::runtime_error("Journal too small for state snapshot: " + path_);
+            }
+        }
+    };
+    snapshot(JournalRecordType::Order, state_.open_orders);
+    snapshot(JournalRecordType::Position, state_.positions);
+    snapshot(JournalRecordType::Ticker, state_.tickers);
+    snapshot(JournalRecordType::OrderBook, state_.order_books);
+    publish(offset);
+}
+
+void SessionJournal::flush() {
+    region_.flush(0, 0, true);
+}
@@ -0,0 +1,84 @@
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+enum class JournalRecordType : uint16_t {
+    Order = 1,      // order object from buy/sell/edit/cancel or a fill
+    Position = 2,
+    Ticker = 3,
+    OrderBook = 4,
+};
+
+// Everything needed to resume trading without re-querying the exchange
+struct JournalState {
+    std::map<std::string, json> open_orders;  // by order_id
+    std::map<std::string, json> positions;    // by instrument_name
+    std::map<std::string, json> tickers;      // by instrument_name
+    std::map<std::string, json> order_books;  // by instrument_name
+    int64_t last_event_us = 0;
+
+    void apply(JournalRecordType type, const json& payload);
+
+};
+
+// Write-ahead journal appended to a memory-mapped file. Records are msgpack
+// payloads behind a small fixed header; a record becomes visible to replay only
+// once the file header's write offset has moved past it. The file holds two halves so
+// compaction can write a snapshot next to the live log and switch over in one store.
+class SessionJournal {
+public:
+    explicit SessionJournal(const std::string& path, uint64_t capacity = 64ull * 1024 * 1024);
+    ~SessionJournal();
+
+    SessionJournal(const SessionJournal&) = delete;
+    SessionJournal& operator=(const SessionJournal&) = delete;
+
+    // Rebuilds state from whatever the previous session left in the file
+    const JournalState& recover();
+
+    // Hot path: serialise, memcpy into the mapping and publish; compacts when full
+    void append(JournalRecordType type, const json& payload);
+
+    // Writes a snapshot of the current state into the idle half and makes it the active one
+    void compact();
+
+    // Ask the OS to write dirty pages back (not needed to survive a process crash)
+    void flush();
+
+    const JournalState& state() const { return state_; }
+    uint64_t bytesUsed() const;
+    uint64_t recoveredRecords() const { return recovered_records_; }
+
+private:
+    struct FileHeader;
+    struct RecordHeader;
+
+    std::string path_;
+    uint64_t capacity_;
+    uint64_t split_ = 0;    // start of the upper half
+    boost::interprocess::file_mapping file_;
+    boost::interprocess::mapped_region region_;
+    FileHeader* header_ = nullptr;
+    char* base_ = nullptr;
+
+    JournalState state_;
+    uint64_t recovered_records_ = 0;
+
+    uint64_t activeBegin() const;
+    uint64_t activeLimit() const;
+    bool write(uint64_t& offset, uint64_t limit, JournalRecordType type, int64_t timestamp_us,
+               const std::vector<uint8_t>& bytes);
+    void publish(uint64_t offset);
+    void reset();
+};
+
+#endif // SESSION_JOURNAL_H
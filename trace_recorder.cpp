@@ -0,0 +1,212 @@
+#include "trace_recorder.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Slot fields are atomics guarded by a per-slot sequence number (seqlock): the writer makes
+// seq odd while it fills the slot and 2 * index + 2 once done, so the exporter can skip slots
+// that are mid-write or were overwritten while it read them.
+struct TraceSlot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> correlation_id{0};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> end_ns{0};
+};
+
+// Single writer (the thread currently leasing it), read by the exporter
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t id) : tid(id), slots(new TraceSlot[TraceRecorder::BUFFER_CAPACITY]) {}
+
+    uint32_t tid;
+    std::unique_ptr<TraceSlot[]> slots;
+    std::atomic<uint64_t> head{0};
+};
+
+std::atomic<bool> g_enabled{true};
+std::atomic<uint64_t> g_next_correlation_id{1};
+
+// Buffers outlive their threads so spans from finished std::async tasks can still be exported.
+// A finished thread's buffer is handed to the next new thread, so memory is bounded by the
+// peak number of concurrent threads; successive short-lived threads share one trace track.
+std::mutex g_registry_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> g_registry;
+std::vector<ThreadBuffer*> g_free_buffers;
+
+struct BufferLease {
+    ThreadBuffer* buffer = nullptr;
+
+    ~BufferLease() {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(g_registry_mutex);
+            g_free_buffers.push_back(buffer);
+        }
+    }
+};
+
+thread_local uint64_t t_current_id = 0;
+thread_local bool t_request_owned = false;
+thread_local BufferLease t_lease;
+
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+ThreadBuffer& threadBuffer() {
+    if (!t_lease.buffer) {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        if (!g_free_buffers.empty()) {
+            t_lease.buffer = g_free_buffers.back();
+            g_free_buffers.pop_back();
+        } else {
+            auto buffer = std::make_shared<ThreadBuffer>(static_cast<uint32_t>(g_registry.size() + 1));
+            g_registry.push_back(buffer);
+            t_lease.buffer = buffer.get();
+        }
+    }
+    return *t_lease.buffer;
+}
+
+} // namespace
+
+void TraceRecorder::setEnabled(bool enabled) {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool TraceRecorder::isEnabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t TraceRecorder::newCorrelationId() {
+    return g_next_correlation_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceRecorder::setCurrentId(uint64_t correlation_id) {
+    t_current_id = correlation_id;
+}
+
+uint64_t TraceRecorder::currentId() {
+    return t_current_id;
+}
+
+void TraceRecorder::beginRequest() {
+    if (t_current_id == 0) {
+        t_current_id = newCorrelationId();
+        t_request_owned = true;
+    }
+}
+
+void TraceRecorder::endRequest() {
+    if (t_request_owned) {
+        t_current_id = 0;
+        t_request_owned = false;
+    }
+}
+
+int64_t TraceRecorder::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+void TraceRecorder::record(const char* name, int64_t start_ns, int64_t end_ns) {
+    record(name, t_current_id, start_ns, end_ns);
+}
+
+void TraceRecorder::record(const char* name, uint64_t correlation_id, int64_t start_ns, int64_t end_ns) {
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t index = buffer.head.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer.slots[index & (BUFFER_CAPACITY - 1)];
+
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.correlation_id.store(correlation_id, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::exportChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error opening trace file: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        buffers = g_registry;
+    }
+
+    // Events are written by hand; building an nlohmann::json array of every event first is far slower
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    size_t written = 0;
+    for (const auto& buffer : buffers) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > BUFFER_CAPACITY ? head - BUFFER_CAPACITY : 0;
+        for (uint64_t i = begin; i < head; ++i) {
+            const TraceSlot& slot = buffer->slots[i & (BUFFER_CAPACITY - 1)];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) {
+                continue;  // being written, or already overwritten by a newer event
+            }
+            TraceEvent event{
+                slot.name.load(std::memory_order_relaxed),
+                slot.correlation_id.load(std::memory_order_relaxed),
+                slot.start_ns.load(std::memory_order_relaxed),
+                slot.end_ns.load(std::memory_order_relaxed)
+            };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq) {
+                continue;  // torn: the writer lapped us while we copied
+            }
+            // Zero-length events are points in time (e.g. a frame arriving) and export as instants
+            out << (first ? "" : ",")
+                << "{\"name\":\"" << event.name << "\",\"cat\":\"hft\"";
+            if (event.end_ns == event.start_ns) {
+                out << ",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << event.start_ns / 1000.0;
+            } else {
+                out << ",\"ph\":\"X\",\"ts\":" << event.start_ns / 1000.0
+                    << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0;
+            }
+            out << ",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"correlation_id\":" << event.correlation_id << "}}";
+            first = false;
+            ++written;
+        }
+    }
+    out << "]}" << std::endl;
+
+    std::cout << "Exported " << written << " trace events to " << path << std::endl;
+    return static_cast<bool>(out);
+}
+
+TraceScope::TraceScope(uint64_t correlation_id)
+    : previous_id_(t_current_id) {
+    t_current_id = correlation_id;
+}
+
+TraceScope::~TraceScope() {
+    t_current_id = previous_id_;
+}
+
+TraceSpan::TraceSpan(const char* name)
+    : name_(name),
+    start_ns_(TraceRecorder::nowNs()) {}
+
+TraceSpan::~TraceSpan() {
+    TraceRecorder::record(name_, start_ns_, TraceRecorder::nowNs());
+}
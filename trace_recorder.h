@@ -0,0 +1,73 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A completed stage of one message, tied to others by its correlation id
+struct TraceEvent {
+    const char* name;         // must be a string literal, it is stored by pointer
+    uint64_t correlation_id;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+class TraceRecorder {
+public:
+    // Turn recording on/off for all threads (on by default)
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Ids are stamped when a frame is received and carried per thread through later stages
+    static uint64_t newCorrelationId();
+    static void setCurrentId(uint64_t correlation_id);
+    static uint64_t currentId();
+
+    // Sends not triggered by a frame get a fresh id for the request and its response;
+    // endRequest() clears it again. Inside a frame's dispatch the frame's id is kept.
+    static void beginRequest();
+    static void endRequest();
+
+    static int64_t nowNs();
+
+    // Appends to the calling thread's buffer; never blocks after the thread's first event.
+    // An event with start_ns == end_ns is an instant (exported with "ph":"i").
+    static void record(const char* name, int64_t start_ns, int64_t end_ns);
+    static void record(const char* name, uint64_t correlation_id, int64_t start_ns, int64_t end_ns);
+
+    // Writes every buffered event as Chrome/Perfetto trace JSON (load via chrome://tracing or ui.perfetto.dev)
+    static bool exportChromeTrace(const std::string& path);
+
+    // Events kept per buffer before the oldest are overwritten; buffers of finished threads are reused
+    static constexpr size_t BUFFER_CAPACITY = 1 << 14;
+};
+
+// Makes `correlation_id` current for the enclosing scope and restores the previous id on exit
+class TraceScope {
+public:
+    explicit TraceScope(uint64_t correlation_id);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    uint64_t previous_id_;
+};
+
+// Records the enclosing scope as one stage under the thread's current correlation id
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_ns_;
+};
+
+#endif // TRACE_RECORDER_H
@@ -1,7 +1,14 @@
 #include "trade_execution.h"
 #include "websocket_handler.h"
 #include "latency_module.h"
+#include "clock_sync.h"
+#include "trace_recorder.h"
+#include "session_journal.h"
+#include "quote_batcher.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <set>
 #include <stdexcept>
 
 std::atomic<int> TradeExecution::request_id{1};
@@ -36,7 +43,7 @@ json TradeExecution::authenticate(const std::string& client_id, const std::strin
             }}
         };
         websocket_.sendMessage(auth_request);
-        auto response = websocket_.readMessage();
+        auto response = websocket_.readResponse(auth_request["id"].get<int>());
 
         if (response.contains("result")) {
             is_authenticated_ = true;
@@ -60,7 +67,7 @@ json TradeExecution::getInstruments(const std::string& currency, const std::stri
             {"params", {{"currency", currency}, {"kind", kind}, {"expired", expired}}}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        return websocket_.readResponse(request["id"].get<int>());
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getInstruments: " << e.what() << std::endl;
@@ -77,7 +84,9 @@ json TradeExecution::getTicker(const std::string& instrument_name) {
             {"params", {{"instrument_name", instrument_name}}}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalResponse(JournalRecordType::Ticker, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getTicker: " << e.what() << std::endl;
@@ -94,7 +103,9 @@ json TradeExecution::getOrderBook(const std::string& instrument_name) {
             {"params", {{"instrument_name", instrument_name}}}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalResponse(JournalRecordType::OrderBook, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getOrderBook: " << e.what() << std::endl;
@@ -117,7 +128,9 @@ json TradeExecution::placeBuyOrder(const std::string& instrument_name, double am
             }}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalResponse(JournalRecordType::Order, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in placeBuyOrder: " << e.what() << std::endl;
@@ -140,7 +153,9 @@ json TradeExecution::placeSellOrder(const std::string& instrument_name, double a
             }}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalResponse(JournalRecordType::Order, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in placeSellOrder: " << e.what() << std::endl;
@@ -158,7 +173,9 @@ json TradeExecution::cancelOrder(const std::string& order_id) {
             {"params", {{"order_id", order_id}}}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalResponse(JournalRecordType::Order, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in cancelOrder: " << e.what() << std::endl;
@@ -181,7 +198,9 @@ json TradeExecution::modifyOrder(const std::string& order_id, double new_price,
             }}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalResponse(JournalRecordType::Order, response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in modifyOrder: " << e.what() << std::endl;
@@ -189,6 +208,72 @@ json TradeExecution::modifyOrder(const std::string& order_id, double new_price,
     }
 }
 
+json TradeExecution::massQuote(const std::string& quote_id, const std::string& mmp_group, const json& quotes) {
+    ensureAuthenticated();
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", getNextRequestId()},
+            {"method", "private/mass_quote"},
+            {"params", {
+                {"quote_id", quote_id},
+                {"mmp_group", mmp_group},
+                {"quotes", quotes}
+            }}
+        };
+        websocket_.sendMessage(request);
+        return websocket_.readResponse(request["id"].get<int>());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in massQuote: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+json TradeExecution::cancelAllByInstrument(const std::string& instrument_name) {
+    ensureAuthenticated();
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", getNextRequestId()},
+            {"method", "private/cancel_all_by_instrument"},
+            {"params", {{"instrument_name", instrument_name}}}
+        };
+        websocket_.sendMessage(request);
+        json response = websocket_.readResponse(request["id"].get<int>());
+        if (response.contains("result")) {
+            journalCancelled("instrument_name", instrument_name);
+        }
+        return response;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in cancelAllByInstrument: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+json TradeExecution::cancelByLabel(const std::string& label) {
+    ensureAuthenticated();
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", getNextRequestId()},
+            {"method", "private/cancel_by_label"},
+            {"params", {{"label", label}}}
+        };
+        websocket_.sendMessage(request);
+        json response = websocket_.readResponse(request["id"].get<int>());
+        if (response.contains("result")) {
+            journalCancelled("label", label);
+        }
+        return response;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in cancelByLabel: " << e.what() << std::endl;
+        throw;
+    }
+}
+
 json TradeExecution::getPositions() {
     ensureAuthenticated();
     try {
@@ -196,10 +281,12 @@ json TradeExecution::getPositions() {
             {"jsonrpc", "2.0"},
             {"id", getNextRequestId()},
             {"method", "private/get_positions"},
-            {"params", {}}
+            {"params", {{"currency", "any"}}}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = websocket_.readResponse(request["id"].get<int>());
+        journalPositions(response);
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getPositions: " << e.what() << std::endl;
@@ -217,7 +304,7 @@ json TradeExecution::viewOpenOrders(const std::string& currency) {
             {"params", {{"currency", currency}}}
         };
         websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        return websocket_.readResponse(request["id"].get<int>());
     }
     catch (const std::exception& e) {
         std::cerr << "Error in viewOpenOrders: " << e.what() << std::endl;
@@ -225,10 +312,113 @@ json TradeExecution::viewOpenOrders(const std::string& currency) {
     }
 }
 
+json TradeExecution::subscribe(const std::vector<std::string>& channels) {
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", getNextRequestId()},
+            {"method", "public/subscribe"},
+            {"params", {{"channels", channels}}}
+        };
+        websocket_.sendMessage(request);
+        return websocket_.readResponse(request["id"].get<int>());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in subscribe: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+json TradeExecution::unsubscribe(const std::vector<std::string>& channels) {
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", getNextRequestId()},
+            {"method", "public/unsubscribe"},
+            {"params", {{"channels", channels}}}
+        };
+        websocket_.sendMessage(request);
+        return websocket_.readResponse(request["id"].get<int>());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in unsubscribe: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+json TradeExecution::subscribeTrades(const std::string& instrument_name, std::function<void(const json&)> callback) {
+    std::string channel = "trades." + instrument_name + ".raw";
+    addMarketDataSubscriber(channel, callback);
+    return subscribe({channel});
+}
+
+json TradeExecution::unsubscribeTrades(const std::string& instrument_name) {
+    return unsubscribe({"trades." + instrument_name + ".raw"});
+}
+
+void TradeExecution::dispatchPending() {
+    while (websocket_.hasPendingMessages()) {
+        json message = websocket_.readMessage();
+        onMarketDataReceived(message);
+    }
+}
+
+void TradeExecution::pollMarketData(int max_messages) {
+    // Heartbeats keep frames arriving while the feed is quiet, so the blocking read returns
+    // and silent channels are still checked
+    if (clock_sync_) {
+        clock_sync_->enableHeartbeat();
+    }
+    try {
+        for (int i = 0; i < max_messages; ++i) {
+            json message = websocket_.readMessage();
+            if (message.is_null()) {
+                break;
+            }
+            onMarketDataReceived(message);
+            if (clock_sync_) {
+                clock_sync_->checkSilentFeeds();
+            }
+            if (quote_batcher_) {
+                quote_batcher_->flushIfDue();
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in pollMarketData: " << e.what() << std::endl;
+        if (clock_sync_) {
+            clock_sync_->disableHeartbeat();
+        }
+        throw;
+    }
+    if (clock_sync_) {
+        clock_sync_->disableHeartbeat();
+    }
+}
+
 void TradeExecution::handleMarketData(const json& data) {
+    TraceSpan span("dispatch");
+    // Exchange subscription notifications are keyed by channel and deliver only their payload
+    if (data.contains("method") && data["method"] == "subscription") {
+        const json& params = data["params"];
+        std::string channel = params.value("channel", "");
+        if (journal_ && params.contains("data")) {
+            journalMarketData(channel, params["data"]);
+        }
+        auto it = market_data_subscribers_.find(channel);
+        if (it != market_data_subscribers_.end()) {
+            TraceSpan callback_span("subscriber_callback");
+            it->second(params["data"]);
+        } else {
+            std::cerr << "No subscribers for channel: " << channel << std::endl;
+        }
+        return;
+    }
+
     if (data.contains("symbol")) {
         std::string symbol = data["symbol"];
         if (market_data_subscribers_.count(symbol)) {
+            TraceSpan callback_span("subscriber_callback");
             market_data_subscribers_[symbol](data);
         } else {
             std::cerr << "No subscribers for symbol: " << symbol << std::endl;
@@ -238,12 +428,202 @@ void TradeExecution::handleMarketData(const json& data) {
     }
 }
 
-void TradeExecution::onMarketDataReceived(const json& market_data) {
+void TradeExecution::onMarketDataReceived(json& market_data) {
+    // Sends made while handling this frame are attributed to it; the id is cleared on return
+    TraceScope trace_scope(websocket_.lastCorrelationId());
     auto start = LatencyModule::start();
+    if (clock_sync_) {
+        if (clock_sync_->handleHeartbeat(market_data)) {
+            return;
+        }
+        clock_sync_->annotate(market_data, websocket_.lastReceiveUs());
+    }
     handleMarketData(market_data);
     LatencyModule::end(start, "Market Data Processing Latency");
 }
 
+void TradeExecution::setClockSync(ClockSync* clock_sync) {
+    clock_sync_ = clock_sync;
+}
+
+void TradeExecution::setQuoteBatcher(QuoteBatcher* batcher) {
+    quote_batcher_ = batcher;
+}
+
+void TradeExecution::setJournal(SessionJournal* journal) {
+    journal_ = journal;
+}
+
+void TradeExecution::journalResponse(JournalRecordType type, const json& response) {
+    if (!journal_ || !response.contains("result")) {
+        return;
+    }
+    try {
+        const json& result = response["result"];
+        if (result.is_array()) {
+            for (const auto& item : result) {
+                journal_->append(type, item);
+            }
+        } else if (type == JournalRecordType::Order && result.contains("order")) {
+            // buy/sell/edit wrap the order together with its immediate trades
+            journal_->append(type, result["order"]);
+        } else if (result.is_object()) {
+            journal_->append(type, result);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error journaling response: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::journalPositions(const json& response) {
+    if (!journal_ || !response.contains("result") || !response["result"].is_array()) {
+        return;
+    }
+    journalResponse(JournalRecordType::Position, response);
+
+    // The list covers every currency, so a journaled position missing from it has been closed,
+    // settled or expired; a zero size erases it
+    std::set<std::string> live;
+    for (const auto& position : response["result"]) {
+        live.insert(position.value("instrument_name", ""));
+    }
+    std::vector<std::string> closed;
+    for (const auto& entry : journal_->state().positions) {
+        if (!live.count(entry.first)) {
+            closed.push_back(entry.first);
+        }
+    }
+    try {
+        for (const auto& instrument : closed) {
+            journal_->append(JournalRecordType::Position, {{"instrument_name", instrument}, {"size", 0.0}});
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error journaling closed positions: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::journalCancelled(const std::string& field, const std::string& value) {
+    if (!journal_) {
+        return;
+    }
+    // Bulk cancels only return a count, so mark the matching journaled orders ourselves
+    std::vector<std::string> cancelled;
+    for (const auto& entry : journal_->state().open_orders) {
+        if (entry.second.value(field, "") == value) {
+            cancelled.push_back(entry.first);
+        }
+    }
+    for (const auto& order_id : cancelled) {
+        journal_->append(JournalRecordType::Order, {{"order_id", order_id}, {"order_state", "cancelled"}});
+    }
+}
+
+void TradeExecution::journalMarketData(const std::string& channel, const json& data) {
+    try {
+        if (channel.rfind("ticker.", 0) == 0) {
+            journal_->append(JournalRecordType::Ticker, data);
+        } else if (channel.rfind("book.", 0) == 0 && data.value("type", "") != "change") {
+            // Incremental book updates are deltas; only full snapshots replace the journaled book
+            journal_->append(JournalRecordType::OrderBook, data);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error journaling market data: " << e.what() << std::endl;
+    }
+}
+
+json TradeExecution::getUserTradesSince(const std::string& currency, int64_t start_timestamp_ms) {
+    ensureAuthenticated();
+    try {
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", getNextRequestId()},
+            {"method", "private/get_user_trades_by_currency_and_time"},
+            {"params", {
+                {"currency", currency},
+                {"start_timestamp", start_timestamp_ms},
+                {"end_timestamp", now_ms},
+                {"count", 1000},
+                {"sorting", "asc"}
+            }}
+        };
+        websocket_.sendMessage(request);
+        return websocket_.readResponse(request["id"].get<int>());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in getUserTradesSince: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+int TradeExecution::reconcileJournal() {
+    if (!journal_ || journal_->state().last_event_us == 0) {
+        return 0;
+    }
+    // This client has no fill stream, so any journaled open order may have filled since it was placed.
+    // Queries use currency "any": linear instruments (e.g. BTC_USDC-PERPETUAL) are listed under
+    // their settlement currency, which the instrument name prefix does not give.
+    int fills = 0;
+    int64_t since_ms = journal_->state().last_event_us / 1000;
+    for (const auto& entry : journal_->state().open_orders) {
+        since_ms = std::min<int64_t>(since_ms, entry.second.value("creation_timestamp", since_ms));
+    }
+
+    // Pages overlap on their boundary timestamp, so trades are counted once by trade_id
+    std::set<std::string> seen;
+    int64_t start_ms = since_ms;
+    bool has_more = true;
+    while (has_more) {
+        json response = getUserTradesSince("any", start_ms);
+        if (!response.contains("result") || !response["result"].contains("trades")) {
+            break;
+        }
+        const json& result = response["result"];
+        bool progressed = false;
+        for (const auto& fill : result["trades"]) {
+            start_ms = std::max<int64_t>(start_ms, fill.value("timestamp", start_ms));
+            if (!seen.insert(fill.value("trade_id", "")).second) {
+                continue;
+            }
+            progressed = true;
+            ++fills;
+            if (fill.value("state", "") == "filled" && fill.contains("order_id")) {
+                journal_->append(JournalRecordType::Order,
+                    {{"order_id", fill["order_id"]}, {"order_state", "filled"}});
+            }
+        }
+        has_more = progressed && result.value("has_more", false);
+    }
+
+    json response = viewOpenOrders("any");
+    if (response.contains("result") && response["result"].is_array()) {
+        // The exchange's open orders are authoritative; anything journaled but no longer listed
+        // was cancelled (or expired) while we were away
+        std::set<std::string> live;
+        for (const auto& order : response["result"]) {
+            live.insert(order.value("order_id", ""));
+            journal_->append(JournalRecordType::Order, order);
+        }
+        std::vector<std::string> closed;
+        for (const auto& entry : journal_->state().open_orders) {
+            if (!live.count(entry.first)) {
+                closed.push_back(entry.first);
+            }
+        }
+        for (const auto& order_id : closed) {
+            journal_->append(JournalRecordType::Order, {{"order_id", order_id}, {"order_state", "cancelled"}});
+        }
+    }
+
+    // Positions also change without fills (settlement, expiry), so they are always refreshed
+    getPositions();
+    return fills;
+}
+
 void TradeExecution::broadcastDummy() {
     std::cout << "Broadcasting dummy message (no-op)." << std::endl;
 }
@@ -5,12 +5,18 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <vector>
 #include <atomic>
+#include <cstdint>
 
 using json = nlohmann::json;
 
 // ⬇️ Forward declaration
 class WebSocketHandler;
+class ClockSync;
+class SessionJournal;
+class QuoteBatcher;
+enum class JournalRecordType : uint16_t;
 
 class TradeExecution {
 public:
@@ -28,10 +34,47 @@ public:
     json cancelOrder(const std::string& order_id);
     json modifyOrder(const std::string& order_id, double new_price, double new_amount);
     json getPositions();
+
+    // Bulk endpoints: one message for many quotes/orders
+    json massQuote(const std::string& quote_id, const std::string& mmp_group, const json& quotes);
+    json cancelAllByInstrument(const std::string& instrument_name);
+    json cancelByLabel(const std::string& label);
     json viewOpenOrders(const std::string& currency);
 
+    // Subscribes to channels; notifications are routed to subscribers keyed by channel name
+    json subscribe(const std::vector<std::string>& channels);
+    json subscribeTrades(const std::string& instrument_name, std::function<void(const json&)> callback);
+
+    // Stops the exchange streaming a channel; subscribers stay registered for frames already queued
+    json unsubscribe(const std::vector<std::string>& channels);
+    json unsubscribeTrades(const std::string& instrument_name);
+
+    // Dispatches notifications queued while waiting for request responses
+    void dispatchPending();
+
+    // Reads `max_messages` notifications and dispatches them through onMarketDataReceived;
+    // with a clock sync set, heartbeats are enabled for the duration so silent feeds are detected
+    void pollMarketData(int max_messages);
+
     void handleMarketData(const json& data);
-    void onMarketDataReceived(const json& market_data);
+    // Takes a reference so the clock sync can tag the notification in place
+    void onMarketDataReceived(json& market_data);
+
+    // Optional: tags notifications with exchange-to-us latency and answers heartbeats
+    void setClockSync(ClockSync* clock_sync);
+
+    // Optional: pollMarketData() flushes the batcher's pending quotes once their window deadline passes
+    void setQuoteBatcher(QuoteBatcher* batcher);
+
+    // Optional: order, position, ticker and book responses and streamed ticker/book snapshots
+    // are appended to the journal
+    void setJournal(SessionJournal* journal);
+
+    // Applies fills since the journal's last event and replaces the journaled open orders and
+    // positions with the exchange's; returns the number of fills
+    int reconcileJournal();
+    // One page of trades in ascending time order; the result's has_more says whether to ask again
+    json getUserTradesSince(const std::string& currency, int64_t start_timestamp_ms);
 
     void broadcastDummy();
     void addMarketDataSubscriber(const std::string& symbol, std::function<void(const json&)> callback);
@@ -41,9 +84,17 @@ private:
     static std::atomic<int> request_id;
     std::map<std::string, std::function<void(const json&)>> market_data_subscribers_;
     bool is_authenticated_ = false;
+    ClockSync* clock_sync_ = nullptr;
+    SessionJournal* journal_ = nullptr;
+    QuoteBatcher* quote_batcher_ = nullptr;
 
     int getNextRequestId();
     void ensureAuthenticated();
+    void journalResponse(JournalRecordType type, const json& response);
+    void journalCancelled(const std::string& field, const std::string& value);
+    // Upserts the positions in a full get_positions result and erases journaled ones it lacks
+    void journalPositions(const json& response);
+    void journalMarketData(const std::string& channel, const json& data);
 };
 
 #endif // TRADE_EXECUTION_H
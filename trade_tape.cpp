@@ -0,0 +1,256 @@
+#include "trade_tape.h"
+#include <algorithm>
+#include <iostream>
+
+// Ring capacity is rounded up to a power of two so slots can be found with a mask
+static size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+InstrumentTape::InstrumentTape(size_t capacity, const std::vector<int64_t>& bar_intervals_ms,
+                               int64_t rolling_window_ms, size_t max_bars)
+    : capacity_(roundUpPowerOfTwo(std::max<size_t>(capacity, 2))),
+    mask_(capacity_ - 1),
+    timestamps_(capacity_),
+    prices_(capacity_),
+    amounts_(capacity_),
+    sides_(capacity_),
+    rolling_amounts_(capacity_),
+    rolling_window_ms_(rolling_window_ms),
+    max_bars_(max_bars) {
+    for (int64_t interval : bar_intervals_ms) {
+        if (interval > 0) {
+            bars_.emplace_back(interval);
+        }
+    }
+}
+
+void InstrumentTape::evictRolling(size_t slot) {
+    rolling_volume_ -= rolling_amounts_[slot];
+    if (sides_[slot] > 0) {
+        rolling_buy_volume_ -= rolling_amounts_[slot];
+    }
+    rolling_tail_ = (rolling_tail_ + 1) & mask_;
+    --rolling_count_;
+}
+
+void InstrumentTape::expireRolling(int64_t now_ms) {
+    while (rolling_count_ > 0 && timestamps_[rolling_tail_] <= now_ms - rolling_window_ms_) {
+        evictRolling(rolling_tail_);
+    }
+}
+
+double InstrumentTape::rollingVolume(int64_t now_ms) {
+    expireRolling(now_ms);
+    return rolling_volume_;
+}
+
+double InstrumentTape::rollingBuyVolume(int64_t now_ms) {
+    expireRolling(now_ms);
+    return rolling_buy_volume_;
+}
+
+void InstrumentTape::addTrade(int64_t timestamp_ms, double price, double amount, int8_t side) {
+    // The slot about to be overwritten may still be counted in the rolling window
+    if (count_ == capacity_ && rolling_count_ > 0 && rolling_tail_ == head_) {
+        evictRolling(head_);
+    }
+
+    timestamps_[head_] = timestamp_ms;
+    prices_[head_] = price;
+    amounts_[head_] = amount;
+    sides_[head_] = side;
+    head_ = (head_ + 1) & mask_;
+    if (count_ < capacity_) {
+        ++count_;
+    }
+
+    total_volume_ += amount;
+    total_notional_ += price * amount;
+
+    // Eviction walks the ring in arrival order, so a late print already outside the window
+    // still takes a slot there but contributes nothing; one inside it expires with its neighbours
+    newest_ms_ = std::max(newest_ms_, timestamp_ms);
+    size_t slot = (head_ - 1) & mask_;
+    rolling_amounts_[slot] = timestamp_ms > newest_ms_ - rolling_window_ms_ ? amount : 0.0;
+    rolling_volume_ += rolling_amounts_[slot];
+    if (side > 0) {
+        rolling_buy_volume_ += rolling_amounts_[slot];
+    }
+    ++rolling_count_;
+    expireRolling(newest_ms_);
+
+    updateBars(timestamp_ms, price, amount);
+}
+
+void InstrumentTape::updateBars(int64_t timestamp_ms, double price, double amount) {
+    for (auto& series : bars_) {
+        int64_t start = timestamp_ms - (timestamp_ms % series.interval_ms);
+
+        if (series.has_current && start < series.current.start_ms) {
+            // Late print: it belongs to a closed bar, which keeps its close; drop it if that bar is gone
+            for (auto it = series.completed.rbegin(); it != series.completed.rend(); ++it) {
+                if (it->start_ms == start) {
+                    it->high = std::max(it->high, price);
+                    it->low = std::min(it->low, price);
+                    it->volume += amount;
+                    it->notional += price * amount;
+                    ++it->trades;
+                    break;
+                }
+                if (it->start_ms < start) {
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if (!series.has_current || start > series.current.start_ms) {
+            if (series.has_current) {
+                series.completed.push_back(series.current);
+                if (series.completed.size() > max_bars_) {
+                    series.completed.pop_front();
+                }
+            }
+            series.current = Bar{start, price, price, price, price, 0.0, 0.0, 0};
+            series.has_current = true;
+        }
+        Bar& bar = series.current;
+        bar.high = std::max(bar.high, price);
+        bar.low = std::min(bar.low, price);
+        bar.close = price;
+        bar.volume += amount;
+        bar.notional += price * amount;
+        ++bar.trades;
+    }
+}
+
+double InstrumentTape::sessionVwap() const {
+    return total_volume_ > 0.0 ? total_notional_ / total_volume_ : 0.0;
+}
+
+double InstrumentTape::lastPrice() const {
+    return count_ > 0 ? prices_[(head_ - 1) & mask_] : 0.0;
+}
+
+const Bar* InstrumentTape::currentBar(int64_t interval_ms) const {
+    for (const auto& series : bars_) {
+        if (series.interval_ms == interval_ms) {
+            return series.has_current ? &series.current : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+const std::deque<Bar>* InstrumentTape::completedBars(int64_t interval_ms) const {
+    for (const auto& series : bars_) {
+        if (series.interval_ms == interval_ms) {
+            return &series.completed;
+        }
+    }
+    return nullptr;
+}
+
+template <typename F>
+void InstrumentTape::scan(int64_t from_ms, int64_t to_ms, F&& accumulate) const {
+    if (count_ == 0) {
+        return;
+    }
+    // The live region is at most two contiguous runs: [tail, capacity) and [0, head)
+    size_t tail = (head_ - count_) & mask_;
+    size_t first_end = tail + count_ <= capacity_ ? tail + count_ : capacity_;
+    size_t second_end = tail + count_ <= capacity_ ? 0 : head_;
+
+    const int64_t* ts = timestamps_.data();
+    const double* px = prices_.data();
+    const double* qty = amounts_.data();
+
+    auto run = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            double in_window = (ts[i] >= from_ms && ts[i] < to_ms) ? 1.0 : 0.0;
+            accumulate(in_window, px[i], qty[i]);
+        }
+    };
+    run(tail, first_end);
+    run(0, second_end);
+}
+
+double InstrumentTape::vwap(int64_t from_ms, int64_t to_ms) const {
+    double notional = 0.0;
+    double volume = 0.0;
+    scan(from_ms, to_ms, [&](double in_window, double price, double amount) {
+        notional += in_window * price * amount;
+        volume += in_window * amount;
+    });
+    return volume > 0.0 ? notional / volume : 0.0;
+}
+
+double InstrumentTape::volume(int64_t from_ms, int64_t to_ms) const {
+    double volume = 0.0;
+    scan(from_ms, to_ms, [&](double in_window, double, double amount) {
+        volume += in_window * amount;
+    });
+    return volume;
+}
+
+TradeTape::TradeTape(size_t capacity_per_instrument, std::vector<int64_t> bar_intervals_ms,
+                     int64_t rolling_window_ms, size_t max_bars)
+    : capacity_(capacity_per_instrument),
+    bar_intervals_ms_(std::move(bar_intervals_ms)),
+    rolling_window_ms_(rolling_window_ms),
+    max_bars_(max_bars) {}
+
+InstrumentTape& TradeTape::instrument(const std::string& instrument_name) {
+    auto& tape = tapes_[instrument_name];
+    if (!tape) {
+        tape = std::make_unique<InstrumentTape>(capacity_, bar_intervals_ms_, rolling_window_ms_, max_bars_);
+    }
+    return *tape;
+}
+
+const InstrumentTape* TradeTape::instrument(const std::string& instrument_name) const {
+    auto it = tapes_.find(instrument_name);
+    return it != tapes_.end() ? it->second.get() : nullptr;
+}
+
+void TradeTape::onTrades(const json& trades) {
+    if (!trades.is_array()) {
+        std::cerr << "Invalid trade data: expected an array" << std::endl;
+        return;
+    }
+    for (const auto& trade : trades) {
+        if (!trade.contains("instrument_name") || !trade.contains("price") || !trade.contains("amount")) {
+            continue;
+        }
+        int8_t side = trade.value("direction", "") == "sell" ? -1 : 1;
+        instrument(trade["instrument_name"].get<std::string>()).addTrade(
+            trade.value("timestamp", int64_t{0}),
+            trade["price"].get<double>(),
+            trade["amount"].get<double>(),
+            side);
+    }
+}
+
+void TradeTape::printSummary(const std::string& instrument_name, int64_t now_ms) {
+    auto it = tapes_.find(instrument_name);
+    InstrumentTape* tape = it != tapes_.end() ? it->second.get() : nullptr;
+    if (!tape || tape->size() == 0) {
+        std::cout << "No trades recorded for " << instrument_name << std::endl;
+        return;
+    }
+    std::cout << instrument_name << " Trades: " << tape->size()
+              << ", Last: " << tape->lastPrice()
+              << ", Session VWAP: " << tape->sessionVwap()
+              << ", Rolling Volume: " << tape->rollingVolume(now_ms)
+              << " (buy " << tape->rollingBuyVolume(now_ms) << ")" << std::endl;
+
+    const Bar* bar = tape->currentBar(60000);
+    if (bar) {
+        std::cout << "1m Bar O/H/L/C/V: " << bar->open << " / " << bar->high << " / "
+                  << bar->low << " / " << bar->close << " / " << bar->volume << std::endl;
+    }
+}
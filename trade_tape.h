@@ -0,0 +1,116 @@
+#ifndef TRADE_TAPE_H
+#define TRADE_TAPE_H
+
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct Bar {
+    int64_t start_ms = 0;
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    double volume = 0.0;
+    double notional = 0.0;
+    uint32_t trades = 0;
+};
+
+// Prints of one instrument, stored column by column in fixed-size rings
+class InstrumentTape {
+public:
+    InstrumentTape(size_t capacity, const std::vector<int64_t>& bar_intervals_ms,
+                   int64_t rolling_window_ms, size_t max_bars);
+
+    void addTrade(int64_t timestamp_ms, double price, double amount, int8_t side);
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return capacity_; }
+
+    // Incremental statistics, O(1) to read
+    double sessionVwap() const;
+    double sessionVolume() const { return total_volume_; }
+
+    // Rolling window as of `now_ms` (exchange time); prints older than the window are evicted first
+    double rollingVolume(int64_t now_ms);
+    double rollingBuyVolume(int64_t now_ms);
+    double lastPrice() const;
+
+    const Bar* currentBar(int64_t interval_ms) const;
+    const std::deque<Bar>* completedBars(int64_t interval_ms) const;
+
+    // Window queries scan the contiguous columns for trades with from_ms <= timestamp < to_ms
+    double vwap(int64_t from_ms, int64_t to_ms) const;
+    double volume(int64_t from_ms, int64_t to_ms) const;
+
+private:
+    struct BarSeries {
+        explicit BarSeries(int64_t interval) : interval_ms(interval) {}
+
+        int64_t interval_ms;
+        bool has_current = false;
+        Bar current;
+        std::deque<Bar> completed;
+    };
+
+    size_t capacity_;
+    size_t mask_;
+    size_t head_ = 0;   // next slot to write
+    size_t count_ = 0;
+
+    std::vector<int64_t> timestamps_;
+    std::vector<double> prices_;
+    std::vector<double> amounts_;
+    std::vector<int8_t> sides_;  // +1 buy aggressor, -1 sell aggressor
+    std::vector<double> rolling_amounts_;  // what each slot added to the rolling sums (0 for stale late prints)
+
+    double total_volume_ = 0.0;
+    double total_notional_ = 0.0;
+
+    int64_t rolling_window_ms_;
+    size_t rolling_tail_ = 0;   // oldest slot still inside the rolling window
+    size_t rolling_count_ = 0;
+    int64_t newest_ms_ = 0;     // latest print timestamp seen, the rolling window ends here
+    double rolling_volume_ = 0.0;
+    double rolling_buy_volume_ = 0.0;
+
+    size_t max_bars_;
+    std::vector<BarSeries> bars_;
+
+    void evictRolling(size_t slot);
+    void expireRolling(int64_t now_ms);
+    void updateBars(int64_t timestamp_ms, double price, double amount);
+    template <typename F>
+    void scan(int64_t from_ms, int64_t to_ms, F&& accumulate) const;
+};
+
+class TradeTape {
+public:
+    explicit TradeTape(size_t capacity_per_instrument = 65536,
+                       std::vector<int64_t> bar_intervals_ms = {1000, 60000, 300000},
+                       int64_t rolling_window_ms = 60000,
+                       size_t max_bars = 1024);
+
+    // Consumes the "data" array of a trades.{instrument}.raw notification
+    void onTrades(const json& trades);
+
+    const InstrumentTape* instrument(const std::string& instrument_name) const;
+    InstrumentTape& instrument(const std::string& instrument_name);
+
+    void printSummary(const std::string& instrument_name, int64_t now_ms);
+
+private:
+    size_t capacity_;
+    std::vector<int64_t> bar_intervals_ms_;
+    int64_t rolling_window_ms_;
+    size_t max_bars_;
+    std::map<std::string, std::unique_ptr<InstrumentTape>> tapes_;
+};
+
+#endif // TRADE_TAPE_H
@@ -1,12 +1,15 @@
 #include "websocket_handler.h"
 #include <iostream> // For debugging (optional)
 #include "latency_module.h"  // Include the LatencyModule header
+#include "trace_recorder.h"
+#include <chrono>
 
 WebSocketHandler::WebSocketHandler(const std::string& host, const std::string& port, const std::string& endpoint )
     : ctx_(ssl::context::tlsv12_client),
     resolver_(ioc_),
     websocket_(ioc_, ctx_),
     host_(host),
+    port_(port),
     endpoint_(endpoint) {
     //trade_execution_(trade_execution) {  // Initialize the TradeExecution reference
     // Load the default SSL certificates
@@ -16,11 +19,14 @@ WebSocketHandler::WebSocketHandler(const std::string& host, const std::string& p
 void WebSocketHandler::connect() {
     try {
         // Resolve the host and port
-        auto const results = resolver_.resolve(host_, "443");
+        auto const results = resolver_.resolve(host_, port_);
 
         // Connect to the server
         asio::connect(websocket_.next_layer().next_layer(), results.begin(), results.end());
 
+        // Disable Nagle so multi-segment frames (e.g. mass quotes) are not held for a delayed ACK
+        websocket_.next_layer().next_layer().set_option(tcp::no_delay(true));
+
         // Perform the SSL handshake
         websocket_.next_layer().handshake(ssl::stream_base::client);
 
@@ -42,10 +48,18 @@ void WebSocketHandler::onMessage(const std::string& message) {
 }
 
 void WebSocketHandler::sendMessage(const json& message) {
+    TraceRecorder::beginRequest();
     try {
         // Serialize the JSON message and send it
-        std::string message_str = message.dump();
-        websocket_.write(asio::buffer(message_str));
+        std::string message_str;
+        {
+            TraceSpan span("encode");
+            message_str = message.dump();
+        }
+        {
+            TraceSpan span("socket_write");
+            websocket_.write(asio::buffer(message_str));
+        }
 
         std::cout << "Sent message: " << message_str << std::endl;
     }
@@ -54,28 +68,89 @@ void WebSocketHandler::sendMessage(const json& message) {
     }
 }
 
-json WebSocketHandler::readMessage() {
+ReceivedFrame WebSocketHandler::readFrame(int expected_id, uint64_t request_trace_id) {
+    ReceivedFrame frame;
     try {
         auto read_start = LatencyModule::start();  // Start timer for WebSocket message read
 
         beast::flat_buffer buffer;
         websocket_.read(buffer);
+        // Time spent blocked waiting for the exchange is not charged to the frame: the trace
+        // marks its arrival and the socket_read stage only covers copying it out of the buffer
+        int64_t received_ns = TraceRecorder::nowNs();
+        frame.receive_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
 
         // Parse the received message as JSON
         std::string message_str = beast::buffers_to_string(buffer.data());
+        int64_t read_end = TraceRecorder::nowNs();
         std::cout << "Received message: " << message_str << std::endl;
 
         // End the timer and log the latency
         LatencyModule::end(read_start, "WebSocket Read Latency");
 
-        return json::parse(message_str);
+        int64_t parse_start = TraceRecorder::nowNs();
+        frame.message = json::parse(message_str);
+        int64_t parse_end = TraceRecorder::nowNs();
+
+        // Spans are recorded once the frame is parsed, since only then do we know whose reply it is
+        bool is_response = request_trace_id != 0 && frame.message.contains("id") && frame.message["id"] == expected_id;
+        frame.correlation_id = is_response ? request_trace_id : TraceRecorder::newCorrelationId();
+        TraceRecorder::record("receive", frame.correlation_id, received_ns, received_ns);
+        TraceRecorder::record("socket_read", frame.correlation_id, received_ns, read_end);
+        TraceRecorder::record("parse", frame.correlation_id, parse_start, parse_end);
     }
     catch (const std::exception& e) {
         std::cerr << "Error reading message: " << e.what() << std::endl;
-        return json();  // Return an empty JSON object in case of error
+        frame.message = json();  // Return an empty JSON object in case of error
+    }
+    return frame;
+}
+
+json WebSocketHandler::readMessage() {
+    ReceivedFrame frame;
+    if (!pending_.empty()) {
+        frame = std::move(pending_.front());
+        pending_.pop_front();
+    } else {
+        frame = readFrame(-1, 0);
+    }
+    last_receive_us_ = frame.receive_us;
+    last_correlation_id_ = frame.correlation_id;
+    return std::move(frame.message);
+}
+
+json WebSocketHandler::readResponse(int id) {
+    uint64_t request_trace_id = TraceRecorder::currentId();
+    while (true) {
+        ReceivedFrame frame = readFrame(id, request_trace_id);
+        if (frame.message.is_null()) {
+            TraceRecorder::endRequest();
+            return json();
+        }
+        if (frame.message.contains("id") && frame.message["id"] == id) {
+            last_receive_us_ = frame.receive_us;
+            last_correlation_id_ = frame.correlation_id;
+            TraceRecorder::endRequest();
+            return std::move(frame.message);
+        }
+        // Notifications arriving ahead of the response are kept for the next readMessage()
+        pending_.push_back(std::move(frame));
     }
 }
 
+bool WebSocketHandler::hasPendingMessages() const {
+    return !pending_.empty();
+}
+
+int64_t WebSocketHandler::lastReceiveUs() const {
+    return last_receive_us_;
+}
+
+uint64_t WebSocketHandler::lastCorrelationId() const {
+    return last_correlation_id_;
+}
+
 void WebSocketHandler::close() {
     try {
         websocket_.close(beast::websocket::close_code::normal);
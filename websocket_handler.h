@@ -10,6 +10,8 @@
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/core.hpp>
+#include <cstdint>
+#include <deque>
 #include <string>
 #include "trade_execution.h"  // Include the TradeExecution header for access
 
@@ -19,6 +21,13 @@ namespace ssl = asio::ssl;
 using tcp = asio::ip::tcp;
 using json = nlohmann::json;
 
+// A frame as it came off the socket, stamped before it is parsed or logged
+struct ReceivedFrame {
+    json message;
+    int64_t receive_us = 0;  // local epoch microseconds
+    uint64_t correlation_id = 0;
+};
+
 class WebSocketHandler {
 public:
     // Constructor now includes TradeExecution reference
@@ -28,6 +37,18 @@ public:
     void onMessage(const std::string& message); // Declare the onMessage function
     void sendMessage(const json& message);
     json readMessage();
+
+    // Reads until the response to request `id` arrives; other frames are queued for readMessage()
+    json readResponse(int id);
+
+    bool hasPendingMessages() const;
+
+    // Local receive time of the frame most recently returned by readMessage()/readResponse()
+    int64_t lastReceiveUs() const;
+
+    // Trace correlation id of that frame; dispatch makes it current while handling the frame
+    uint64_t lastCorrelationId() const;
+
     void close();
 
 private:
@@ -36,7 +57,14 @@ private:
     tcp::resolver resolver_;
     beast::websocket::stream<ssl::stream<tcp::socket>> websocket_;
     std::string host_;
+    std::string port_;
     std::string endpoint_;
+    std::deque<ReceivedFrame> pending_;
+    int64_t last_receive_us_ = 0;
+    uint64_t last_correlation_id_ = 0;
+
+    // A frame answering `expected_id` is traced under `request_trace_id`; any other frame gets a new id
+    ReceivedFrame readFrame(int expected_id, uint64_t request_trace_id);
     // TradeExecution& trade_execution_;  // Reference to TradeExecution object
 };
 